@@ -29,6 +29,8 @@
 #pragma once
 
 #include <Arduino.h>
+#include "TimerWheel.h"
+#include "ConfigStore.h"
 
 /**
  * @class AudioPlayer
@@ -36,7 +38,8 @@
  * 
  * Provides high-level methods to control audio playback on the DFPlayer PRO
  * module. Handles UART communication, command formatting, and timing delays
- * required for reliable operation.
+ * required for reliable operation. Waits between commands are scheduled on
+ * the shared TimerWheel so they don't block the main loop.
  */
 class AudioPlayer {
 public:
@@ -44,25 +47,39 @@ public:
    * @brief Constructor
    * @param txPin GPIO pin for UART TX (Pico → DFPlayer RX)
    * @param rxPin GPIO pin for UART RX (Pico ← DFPlayer TX)
+   * @param timers Timing wheel used to schedule waits (advanced by main loop)
+   * @param config Tunable parameters (waits, command pacing, initial volume)
    */
-  AudioPlayer(uint8_t txPin, uint8_t rxPin);
+  AudioPlayer(uint8_t txPin, uint8_t rxPin, TimerWheel &timers, const ConfigStore &config);
 
   /**
    * @brief Initialize Serial1 and configure the DFPlayer PRO
    * 
-   * This method:
-   * 1. Configures Serial1 with the specified TX/RX pins at 115200 baud
-   * 2. Waits for DFPlayer to boot (1 second)
+   * This method configures Serial1 with the specified TX/RX pins at
+   * 115200 baud and starts the configuration sequence. The remaining steps
+   * run from timers while the main loop keeps going:
+   * 1. Waits for DFPlayer to boot (1 second)
+   * 2. Disables voice prompts (AT+PROMPT=OFF)
    * 3. Switches to MUSIC mode using AT+FUNCTION=MUSIC
    * 4. Sets playback mode to loop single track (AT+PLAYMODE=1)
-   * 5. Sets initial volume to 15
+   * 5. Applies the current volume (df_initial_volume unless setVolume() was called)
    * 
-   * @return true if initialization succeeded, false otherwise
+   * Wait durations are read from ConfigStore (df_boot_ms, df_prompt_ms,
+   * df_mode_switch_ms).
+   * 
+   * isReady() becomes true once the sequence has completed.
+   * 
+   * @return Always true (the sequence cannot fail to start; use isReady()
+   *         to know when it has completed)
    */
   bool begin();
 
   /**
    * @brief Set the output volume
+   * 
+   * Before the player is ready, the volume is stored and applied at the
+   * end of initialization.
+   * 
    * @param vol Volume level (0-30, where 0 is mute and 30 is maximum)
    */
   void setVolume(uint8_t vol);
@@ -71,7 +88,9 @@ public:
    * @brief Play a specific track by number
    * 
    * Plays the file /000X.mp3 where X is the track number.
-   * Also re-enforces AT+PLAYMODE=1 to ensure infinite looping.
+   * Also re-enforces AT+PLAYMODE=1 (df_loop_mode_ms later, via a timer) to ensure
+   * infinite looping. If the player is not ready yet, the track is queued
+   * and started at the end of initialization.
    * 
    * @param track Track number (1-9999). 0 is ignored.
    */
@@ -82,7 +101,8 @@ public:
    * 
    * Sends AT+PLAY=PP command to toggle play/pause state.
    * Note: Used carefully in main loop with state tracking to avoid
-   * unintended toggle behavior.
+   * unintended toggle behavior. Before the player is ready, this only
+   * drops a queued track.
    */
   void pause();
 
@@ -104,14 +124,41 @@ public:
   bool isReady() const { return _ready; }
 
 private:
-  uint8_t _txPin;  ///< UART TX pin
-  uint8_t _rxPin;  ///< UART RX pin
-  bool _ready;     ///< Initialization status flag
+  uint8_t _txPin;          ///< UART TX pin
+  uint8_t _rxPin;          ///< UART RX pin
+  bool _ready;             ///< Initialization status flag
+  TimerWheel &_timers;     ///< Shared timing wheel
+  const ConfigStore &_config;  ///< Tunable parameters
+  Timer _initTimer;        ///< Paces the initialization sequence
+  Timer _loopModeTimer;    ///< Deferred PLAYMODE=1 after starting a track
+  uint8_t _initStep;       ///< Next step of the initialization sequence
+  uint8_t _volume;         ///< Last requested volume (0-30)
+  uint16_t _pendingTrack;  ///< Track requested before ready (0 = none)
+
+  /**
+   * @brief Run the next step of the initialization sequence
+   * 
+   * Called from _initTimer; each step arms the timer for the next one.
+   */
+  void continueInit();
+
+  /**
+   * @brief Timer callback for _initTimer
+   * @param arg AudioPlayer instance
+   */
+  static void onInitTimer(void *arg);
+
+  /**
+   * @brief Timer callback for _loopModeTimer
+   * @param arg AudioPlayer instance
+   */
+  static void onLoopModeTimer(void *arg);
   
   /**
    * @brief Send an AT command to the DFPlayer PRO
    * 
-   * Appends \r\n (via println) and waits 50ms for command processing.
+   * Appends \r\n (via println) and waits df_command_ms (50ms by default)
+   * for command processing.
    * 
    * @param cmd AT command string (without \r\n)
    */
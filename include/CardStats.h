@@ -0,0 +1,158 @@
+/**
+ * @file CardStats.h
+ * @brief Per-card usage analytics (play count, play time, last seen)
+ * @author Jérémy Martin, generated with GitHub Copilot and ChatGPT
+ * @date 2025
+ *
+ * This module keeps a fixed-size table in RAM with one aggregate per card
+ * UID. main.cpp reports play start/stop events, and the table is persisted
+ * to the Pico's flash (LittleFS) so the statistics survive reboots.
+ *
+ * Aggregates per card:
+ * - Play count (number of times the card started a track)
+ * - Total play time in seconds
+ * - Last seen: boot number and uptime (seconds) of the last play
+ *
+ * Persistence:
+ * - Updates are kept as pending deltas on each entry
+ * - The running play's elapsed time is credited on every flush, so a card
+ *   left on the reader is saved while it plays (at most one interval lost)
+ * - Every FLUSH_INTERVAL_MS, at most FLUSH_BATCH dirty entries are appended
+ *   to /stats.log as delta records (small writes, no full rewrite)
+ * - At boot the log is replayed to rebuild the table
+ * - When the log grows past COMPACT_SIZE it is rewritten as one snapshot
+ *   record per card
+ *
+ * Cost on the card path:
+ * - playStarted(): one hash lookup (open addressing, O(1) expected)
+ * - playStopped(): O(1) using the cached entry of the playing card
+ *
+ * Requires a filesystem in platformio.ini (board_build.filesystem_size).
+ * LittleFS is mounted on that area minus the ConfigStore sectors at its
+ * start (ConfigStore::REGION_SIZE).
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "TimerWheel.h"
+
+/**
+ * @class CardStats
+ * @brief Fixed-size per-UID aggregate table with incremental flushing
+ */
+class CardStats {
+public:
+  static const uint16_t TABLE_SIZE = 128;            ///< Hash table slots (power of 2)
+  static const uint16_t MAX_CARDS = 96;              ///< Cards tracked (keeps probes short)
+  static const uint8_t UID_LEN = 30;                 ///< "AA:BB:...:JJ" (10 bytes) + NUL
+  static const uint8_t FLUSH_BATCH = 8;              ///< Max records written per flush
+  static const uint32_t FLUSH_INTERVAL_MS = 60000;   ///< Time between flushes
+  static const uint32_t COMPACT_SIZE = 16384;        ///< Log size that triggers compaction
+
+  /**
+   * @brief Constructor
+   * @param timers Timing wheel used for periodic flushing
+   */
+  explicit CardStats(TimerWheel &timers);
+
+  /**
+   * @brief Mount the filesystem and rebuild the table from the log
+   *
+   * Must be called in setup() after timers.begin(). Starts the periodic
+   * flush timer. If the filesystem cannot be mounted, statistics are
+   * still collected in RAM but not persisted.
+   *
+   * @return true if the filesystem was mounted, false otherwise
+   */
+  bool begin();
+
+  /**
+   * @brief Record that a card started playing
+   *
+   * Stops the previous play first if one is still running.
+   *
+   * @param uid Card UID in format "AA:BB:CC:DD"
+   */
+  void playStarted(const String &uid);
+
+  /**
+   * @brief Record that the current play stopped
+   *
+   * Adds the play time not yet credited by flush() to the playing card.
+   * Does nothing if no card is playing.
+   */
+  void playStopped();
+
+  /**
+   * @brief Credit the running play, then append pending deltas to the log
+   * @param maxEntries Maximum number of cards written in this batch
+   */
+  void flush(uint8_t maxEntries = FLUSH_BATCH);
+
+  /**
+   * @brief Print the whole table to Serial
+   */
+  void dump() const;
+
+private:
+  /**
+   * @brief In-RAM aggregate for one card
+   */
+  struct Entry {
+    char uid[UID_LEN];        ///< Card UID (empty = free slot)
+    bool queued;              ///< Entry is in the dirty queue
+    uint32_t plays;           ///< Total play count
+    uint32_t seconds;         ///< Total play time
+    uint32_t lastSeen;        ///< Uptime (s) of the last play
+    uint16_t lastBoot;        ///< Boot number of the last play
+    uint32_t pendingPlays;    ///< Plays not yet written to flash
+    uint32_t pendingSeconds;  ///< Play time not yet written to flash
+  };
+
+  TimerWheel &_timers;              ///< Shared timing wheel
+  Timer _flushTimer;                ///< Periodic flush
+  Entry _entries[TABLE_SIZE];       ///< Open-addressing hash table
+  uint16_t _count;                  ///< Number of cards in the table
+  uint16_t _dirty[MAX_CARDS];       ///< Ring queue of entries with pending deltas
+  uint16_t _dirtyHead;              ///< Index of the oldest dirty entry
+  uint16_t _dirtyCount;             ///< Number of dirty entries
+  int16_t _current;                 ///< Entry of the playing card (-1 = none)
+  uint32_t _startMs;                ///< millis() up to which the current play is credited
+  uint16_t _bootId;                 ///< Number of this boot
+  uint32_t _dropped;                ///< Plays not recorded because the table is full
+  bool _mounted;                    ///< Filesystem available
+  bool _logDamaged;                 ///< Log ends with a partial record (no appends until compacted)
+
+  /**
+   * @brief Find the entry for a UID, optionally creating it
+   * @param uid Card UID (NUL-terminated)
+   * @param create Insert a new entry if the UID is unknown
+   * @return Entry index, or -1 if not found / table full
+   */
+  int16_t lookup(const char *uid, bool create);
+
+  /**
+   * @brief Add an entry to the dirty queue (once)
+   * @param index Entry index
+   */
+  void markDirty(uint16_t index);
+
+  /**
+   * @brief Rebuild the table by replaying the log
+   */
+  void load();
+
+  /**
+   * @brief Rewrite the log as one snapshot record per card
+   *
+   * Clears _logDamaged on success.
+   */
+  void compact();
+
+  /**
+   * @brief Timer callback for _flushTimer
+   * @param arg CardStats instance
+   */
+  static void onFlushTimer(void *arg);
+};
@@ -0,0 +1,183 @@
+/**
+ * @file ConfigStore.h
+ * @brief Wear-levelled flash key-value store for tunable parameters
+ * @author Jérémy Martin, generated with GitHub Copilot and ChatGPT
+ * @date 2025
+ *
+ * This module stores the firmware's timing and behaviour parameters in
+ * flash, so a site can be tuned over Serial without rebuilding. Every
+ * parameter has a compile-time default and an allowed range (see
+ * ConfigStore.cpp); only values that were changed are stored.
+ *
+ * Flash Layout:
+ * - The first SECTORS flash sectors (4 KB each) of the filesystem area
+ *   (board_build.filesystem_size), so the linker keeps them out of the
+ *   firmware image
+ * - CardStats mounts LittleFS on the rest of the area (after REGION_SIZE)
+ * - Each sector: 8-byte header (magic + sequence number) then 8-byte records
+ * - Record: key (16 bits), check (16 bits), value (32 bits)
+ *
+ * Append-Only Log:
+ * - set() appends one record to the active sector (one 256-byte page write)
+ * - When the active sector is full, the next sector in the ring is erased
+ *   and receives one record per stored key (compaction); its header is
+ *   written last, so a power loss keeps the previous sector valid
+ * - Rotating through the ring spreads erases evenly (wear levelling)
+ *
+ * RAM Index:
+ * - At boot, the sector with the highest sequence number is scanned once
+ *   (at most 511 records, well under a millisecond) into a value array
+ *   indexed by key, preloaded with the defaults
+ * - get() is a single array read (O(1))
+ *
+ * Adding a Parameter:
+ * 1. Add a key to ConfigKey with a new, never reused number
+ * 2. Add its name, default and range to the table in ConfigStore.cpp
+ * 3. Read it with config.get(CFG_...) where it is used
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Parameter keys
+ *
+ * Numbers are stored in flash: never renumber or reuse a key.
+ */
+enum ConfigKey : uint16_t {
+  CFG_REMOVAL_TIMEOUT_MS = 1,    ///< main: time without reads before card is removed
+  CFG_POLL_INTERVAL_MS = 2,      ///< main: delay between card polls
+  CFG_MIN_VOLUME = 3,            ///< main: volume at potentiometer minimum
+  CFG_MAX_VOLUME = 4,            ///< main: volume at potentiometer maximum
+  CFG_DF_BOOT_MS = 10,           ///< AudioPlayer: DFPlayer boot wait
+  CFG_DF_PROMPT_MS = 11,         ///< AudioPlayer: wait after AT+PROMPT=OFF
+  CFG_DF_MODE_SWITCH_MS = 12,    ///< AudioPlayer: wait after AT+FUNCTION=MUSIC
+  CFG_DF_LOOP_MODE_MS = 13,      ///< AudioPlayer: delay before re-enforcing PLAYMODE=1
+  CFG_DF_COMMAND_MS = 14,        ///< AudioPlayer: pause after each AT command
+  CFG_DF_INITIAL_VOLUME = 15,    ///< AudioPlayer: volume set at initialization
+};
+
+/**
+ * @brief Result of ConfigStore::set()
+ */
+enum ConfigResult : uint8_t {
+  CONFIG_OK,              ///< Value stored (or already stored)
+  CONFIG_UNKNOWN_KEY,     ///< Key is not in the parameter table
+  CONFIG_OUT_OF_RANGE,    ///< Value is outside the key's range
+  CONFIG_FLASH_ERROR,     ///< Flash is unavailable or the write failed
+};
+
+/**
+ * @class ConfigStore
+ * @brief Append-only key-value log in flash with an O(1) RAM index
+ */
+class ConfigStore {
+public:
+  static const uint16_t MAX_KEYS = 384;                ///< Keys must be below this value
+  static const uint8_t SECTORS = 4;                    ///< Sectors in the wear-levelling ring
+  static const uint32_t REGION_SIZE = SECTORS * 4096;  ///< Bytes used at the start of the filesystem area
+
+  /**
+   * @brief Constructor (all parameters at their defaults)
+   */
+  ConfigStore();
+
+  /**
+   * @brief Load stored values from flash
+   *
+   * Must be called in setup() before the modules read their parameters.
+   * If the filesystem area is not larger than REGION_SIZE, the region is
+   * not scanned: every parameter reads its default and set() fails.
+   *
+   * @return true if the store is writable, false otherwise
+   */
+  bool begin();
+
+  /**
+   * @brief Read a parameter
+   * @param key Parameter key
+   * @return Stored value, or the default if never set (0 for unknown keys)
+   */
+  uint32_t get(uint16_t key) const { return key < MAX_KEYS ? _values[key] : 0; }
+
+  /**
+   * @brief Store a parameter
+   *
+   * Writing the value already stored does not touch flash. Values outside
+   * the key's range are rejected, so a bad setting can't lock up the loop.
+   *
+   * @param key Parameter key (must be in the parameter table)
+   * @param value New value
+   * @return CONFIG_OK if stored, otherwise the reason it was rejected
+   */
+  ConfigResult set(uint16_t key, uint32_t value);
+
+  /**
+   * @brief Remove a stored parameter (back to its default)
+   * @param key Parameter key
+   * @return true if removed (or not stored), false on error
+   */
+  bool reset(uint16_t key);
+
+  /**
+   * @brief Check if a parameter has a stored value
+   * @param key Parameter key
+   * @return true if set in flash, false if using the default
+   */
+  bool isStored(uint16_t key) const {
+    return key < MAX_KEYS && (_stored[key >> 3] & (1 << (key & 7)));
+  }
+
+  /**
+   * @brief Find a parameter key by its name
+   * @param name Parameter name (e.g. "removal_timeout_ms")
+   * @param keyOut Receives the key if found
+   * @return true if the name is known
+   */
+  static bool keyForName(const String &name, uint16_t &keyOut);
+
+  /**
+   * @brief Get the allowed range of a parameter
+   * @param key Parameter key
+   * @param minOut Receives the smallest allowed value
+   * @param maxOut Receives the largest allowed value
+   * @return true if the key is in the parameter table
+   */
+  static bool rangeFor(uint16_t key, uint32_t &minOut, uint32_t &maxOut);
+
+  /**
+   * @brief Print every known parameter and the log state to Serial
+   */
+  void dump() const;
+
+private:
+  uint32_t _values[MAX_KEYS];           ///< Current value of each key
+  uint8_t _stored[(MAX_KEYS + 7) / 8];  ///< Bitmap of keys stored in flash
+  uint16_t _storedCount;                ///< Number of stored keys
+  const uint8_t *_region;               ///< First byte of the store region (XIP)
+  int8_t _active;                       ///< Active sector (-1 = none yet)
+  uint32_t _sequence;                   ///< Sequence number of the active sector
+  uint16_t _nextSlot;                   ///< Next free record slot in the active sector
+  bool _writable;                       ///< Region fits in the filesystem area
+  uint32_t _loadMicros;                 ///< Duration of the last begin() scan
+
+  /**
+   * @brief Set the in-RAM value of every key to its default
+   */
+  void loadDefaults();
+
+  /**
+   * @brief Append a record to the active sector, rotating if it is full
+   * @param key Record key (may carry the deleted flag)
+   * @param value Record value
+   * @return true if written
+   */
+  bool append(uint16_t key, uint32_t value);
+
+  /**
+   * @brief Erase the next sector and copy every stored key into it
+   * @return true if the new sector is active
+   */
+  bool rotate();
+};
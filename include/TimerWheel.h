@@ -0,0 +1,154 @@
+/**
+ * @file TimerWheel.h
+ * @brief Hierarchical timing wheel for firmware timeouts
+ * @author Jérémy Martin, generated with GitHub Copilot and ChatGPT
+ * @date 2025
+ *
+ * This module provides a single place for every time-based behaviour in the
+ * firmware (card removal grace period, deferred DFPlayer commands, periodic
+ * jobs, ...). Instead of scattering delay() calls and loop counters across
+ * the code, a module arms a Timer and gets a callback when it expires.
+ *
+ * Design:
+ * - LEVELS wheels of SLOTS slots each (4 x 64 by default)
+ * - Level 0 slots are one tick wide, level N slots are 64^N ticks wide
+ * - Timers are intrusive linked-list nodes owned by the caller, so the
+ *   wheel never allocates memory (everything is static)
+ * - arm() and cancel() are O(1); advance() is O(1) per elapsed tick plus
+ *   the timers that expire or cascade down from a higher level
+ *
+ * Range:
+ * - With the default 10 ms tick the wheel covers 64^4 ticks (~46 hours)
+ * - Longer delays are clamped to the maximum range
+ *
+ * Usage:
+ * 1. Declare a Timer (global or member) for each timeout
+ * 2. Call timers.arm(timer, delayMs, callback, arg)
+ * 3. Call timers.advance(millis()) from the main loop
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+/**
+ * @brief Callback invoked when a timer expires
+ * @param arg User pointer given to TimerWheel::arm()
+ */
+typedef void (*TimerCallback)(void *arg);
+
+/**
+ * @struct Timer
+ * @brief A single timeout, owned by the caller and linked into the wheel
+ *
+ * Must not be copied or destroyed while armed. A timer can be re-armed
+ * (including from its own callback) and cancelled at any time.
+ */
+struct Timer {
+  Timer *next = nullptr;            ///< Next timer in the same slot
+  Timer **pprev = nullptr;          ///< Link pointing to this timer (null when idle)
+  uint32_t expires = 0;             ///< Expiry time in wheel ticks
+  TimerCallback callback = nullptr; ///< Function called on expiry
+  void *arg = nullptr;              ///< User pointer passed to the callback
+
+  /**
+   * @brief Check if the timer is currently waiting to expire
+   * @return true if armed, false if idle, expired or cancelled
+   */
+  bool isArmed() const { return pprev != nullptr; }
+};
+
+/**
+ * @class TimerWheel
+ * @brief Statically allocated hierarchical timing wheel
+ *
+ * Time is measured in ticks of tickMs milliseconds. The wheel keeps its
+ * own tick counter and only consumes elapsed milliseconds, so it is not
+ * affected by the 49-day millis() rollover.
+ */
+class TimerWheel {
+public:
+  static const uint8_t LEVELS = 4;              ///< Number of wheels
+  static const uint8_t SLOT_BITS = 6;           ///< log2(slots per wheel)
+  static const uint16_t SLOTS = 1 << SLOT_BITS; ///< Slots per wheel
+  static const uint32_t MAX_TICKS =
+      (1UL << (LEVELS * SLOT_BITS)) - 1;        ///< Longest delay in ticks
+
+  /**
+   * @brief Constructor
+   * @param tickMs Tick length in milliseconds (timer resolution)
+   */
+  explicit TimerWheel(uint16_t tickMs = 10);
+
+  /**
+   * @brief Set the wheel's time origin
+   *
+   * Should be called once in setup() before arming timers.
+   *
+   * @param nowMs Current time, typically millis()
+   */
+  void begin(uint32_t nowMs);
+
+  /**
+   * @brief Arm (or re-arm) a timer
+   *
+   * If the timer is already armed it is moved to its new expiry time.
+   * The delay is rounded up to whole ticks; a delay of 0 expires at the
+   * next tick.
+   *
+   * @param timer Timer to arm
+   * @param delayMs Delay in milliseconds from the last processed tick
+   * @param callback Function called on expiry
+   * @param arg User pointer passed to the callback
+   */
+  void arm(Timer &timer, uint32_t delayMs, TimerCallback callback, void *arg = nullptr);
+
+  /**
+   * @brief Cancel a timer
+   *
+   * Safe to call on an idle timer (does nothing).
+   *
+   * @param timer Timer to cancel
+   */
+  void cancel(Timer &timer);
+
+  /**
+   * @brief Advance the wheel to the current time and run expired timers
+   *
+   * Callbacks run from this call, in the caller's context. They may arm
+   * or cancel any timer, including the one being run.
+   *
+   * @param nowMs Current time, typically millis()
+   */
+  void advance(uint32_t nowMs);
+
+  /**
+   * @brief Get the tick length
+   * @return Tick length in milliseconds
+   */
+  uint16_t tickMs() const { return _tickMs; }
+
+private:
+  uint16_t _tickMs;                 ///< Tick length in milliseconds
+  uint32_t _lastMs;                 ///< millis() value matching _ticks
+  uint32_t _ticks;                  ///< Next tick to be processed
+  Timer *_slots[LEVELS][SLOTS];     ///< Slot list heads for each wheel
+
+  /**
+   * @brief Link a timer into the slot matching its expiry time
+   * @param timer Timer with expires already set
+   */
+  void insert(Timer &timer);
+
+  /**
+   * @brief Re-insert every timer of a higher-level slot into lower levels
+   * @param level Wheel level (1 to LEVELS-1)
+   * @param slot Slot index in that wheel
+   */
+  void cascade(uint8_t level, uint8_t slot);
+
+  /**
+   * @brief Process a single tick: cascade if needed and run expired timers
+   */
+  void step();
+};
@@ -8,10 +8,17 @@
 #include "AudioPlayer.h"
 
 // Constructor: Store pin configuration
-AudioPlayer::AudioPlayer(uint8_t txPin, uint8_t rxPin)
+// Timings and initial volume are read from config when they are used
+AudioPlayer::AudioPlayer(uint8_t txPin, uint8_t rxPin, TimerWheel &timers,
+                         const ConfigStore &config)
   : _txPin(txPin),
     _rxPin(rxPin),
-    _ready(false) {}
+    _ready(false),
+    _timers(timers),
+    _config(config),
+    _initStep(0),
+    _volume(15),
+    _pendingTrack(0) {}
 
 /**
  * Send an AT command to the DFPlayer PRO module
@@ -20,7 +27,7 @@ AudioPlayer::AudioPlayer(uint8_t txPin, uint8_t rxPin)
  */
 void AudioPlayer::sendATCommand(const String& cmd) {
   Serial1.println(cmd);  // AT commands need \r\n (println adds them)
-  delay(50);  // Wait for command to process
+  delay(_config.get(CFG_DF_COMMAND_MS));  // Wait for command to process
 }
 
 /**
@@ -29,12 +36,11 @@ void AudioPlayer::sendATCommand(const String& cmd) {
  * Initialization sequence:
  * 1. Configure Serial1 pins for UART communication
  * 2. Start UART at 115200 baud (DFPlayer PRO fixed rate)
- * 3. Wait 1 second for DFPlayer boot sequence
- * 4. Switch to MUSIC mode (from other modes like BT/AUX)
- * 5. Configure single track looping (PLAYMODE=1)
- * 6. Set default volume
+ * 3. Arm a timer for the DFPlayer boot wait (df_boot_ms, 1 second by default)
  * 
- * @return Always returns true after initialization
+ * The remaining steps run from continueInit() as the timer expires.
+ * 
+ * @return Always returns true once the sequence has been started
  */
 bool AudioPlayer::begin() {
   Serial.println("AudioPlayer: initializing DFPlayer PRO...");
@@ -44,30 +50,68 @@ bool AudioPlayer::begin() {
   Serial1.setRX(_rxPin);
   Serial1.begin(115200);  // DFPlayer PRO uses 115200 baud
   
-  delay(1000);  // Wait for DFPlayer to boot (critical for reliable operation)
-  
-  // Disable voice prompts (removes "music" announcement and other spoken feedback)
-  Serial.println("AudioPlayer: disabling voice prompts...");
-  sendATCommand("AT+PROMPT=OFF");
-  delay(200);
-  
-  // Switch to MUSIC function (no voice announcement now)
-  Serial.println("AudioPlayer: switching to MUSIC mode...");
-  sendATCommand("AT+FUNCTION=MUSIC");
-  delay(500);  // Wait for mode switch to complete
-  
-  // Set play mode to repeat one song infinitely
-  // Mode 1 = Loop single track (vs mode 0 = play once)
-  sendATCommand("AT+PLAYMODE=1");
-  
-  // Set initial volume (middle range)
-  setVolume(15);
-  
-  _ready = true;
-  Serial.println("AudioPlayer: DFPlayer PRO ready.");
+  // Wait for DFPlayer to boot (critical for reliable operation)
+  _ready = false;
+  _initStep = 0;
+  _volume = _config.get(CFG_DF_INITIAL_VOLUME);
+  _timers.arm(_initTimer, _config.get(CFG_DF_BOOT_MS), onInitTimer, this);
   return true;
 }
 
+/**
+ * Run one step of the initialization sequence
+ * 
+ * Each step sends its command and arms _initTimer for the wait the
+ * DFPlayer needs before the next one:
+ * 0. Disable voice prompts, wait df_prompt_ms (200ms)
+ * 1. Switch to MUSIC mode, wait df_mode_switch_ms (500ms)
+ * 2. Configure single track looping, apply volume, start queued track
+ */
+void AudioPlayer::continueInit() {
+  switch (_initStep++) {
+    case 0:
+      // Disable voice prompts (removes "music" announcement and other spoken feedback)
+      Serial.println("AudioPlayer: disabling voice prompts...");
+      sendATCommand("AT+PROMPT=OFF");
+      _timers.arm(_initTimer, _config.get(CFG_DF_PROMPT_MS), onInitTimer, this);
+      break;
+
+    case 1:
+      // Switch to MUSIC function (no voice announcement now)
+      Serial.println("AudioPlayer: switching to MUSIC mode...");
+      sendATCommand("AT+FUNCTION=MUSIC");
+      _timers.arm(_initTimer, _config.get(CFG_DF_MODE_SWITCH_MS), onInitTimer, this);  // Wait for mode switch
+      break;
+
+    default:
+      // Set play mode to repeat one song infinitely
+      // Mode 1 = Loop single track (vs mode 0 = play once)
+      sendATCommand("AT+PLAYMODE=1");
+
+      _ready = true;
+      setVolume(_volume);  // Initial volume, or the one requested during boot
+      Serial.println("AudioPlayer: DFPlayer PRO ready.");
+
+      // Start a card that was placed on the reader during initialization
+      if (_pendingTrack != 0) {
+        uint16_t track = _pendingTrack;
+        _pendingTrack = 0;
+        playTrack(track);
+      }
+      break;
+  }
+}
+
+// Timer callback: advance the initialization sequence
+void AudioPlayer::onInitTimer(void *arg) {
+  static_cast<AudioPlayer *>(arg)->continueInit();
+}
+
+// Timer callback: re-enforce loop mode after starting a track
+void AudioPlayer::onLoopModeTimer(void *arg) {
+  static_cast<AudioPlayer *>(arg)->sendATCommand("AT+PLAYMODE=1");  // Repeat single track
+}
+
 /**
  * Set the output volume level
  * DFPlayer PRO volume range: 0 (mute) to 30 (maximum)
@@ -75,6 +119,8 @@ bool AudioPlayer::begin() {
  */
 void AudioPlayer::setVolume(uint8_t vol) {
   if (vol > 30) vol = 30;  // Clamp to maximum
+  _volume = vol;
+  if (!_ready) return;  // Applied at the end of initialization
   sendATCommand("AT+VOL=" + String(vol));
 }
 
@@ -87,14 +133,23 @@ void AudioPlayer::setVolume(uint8_t vol) {
  *   Track 42  → /0042.mp3
  *   Track 999 → /0999.mp3
  * 
- * After starting playback, re-enforces PLAYMODE=1 to ensure
- * the track loops infinitely (workaround for DFPlayer reset behavior)
+ * After starting playback, re-enforces PLAYMODE=1 (df_loop_mode_ms later,
+ * from a timer) to ensure the track loops infinitely (workaround for DFPlayer
+ * reset behavior). Before initialization has completed, the track is
+ * only queued.
  * 
  * @param track Track number (1-9999). Track 0 is ignored (used for "unknown card")
  */
 void AudioPlayer::playTrack(uint16_t track) {
   if (track == 0) return;  // Skip invalid/unknown tracks
   
+  if (!_ready) {
+    Serial.print("AudioPlayer: not ready, queuing track ");
+    Serial.println(track);
+    _pendingTrack = track;
+    return;
+  }
+  
   Serial.print("AudioPlayer: play track ");
   Serial.println(track);
   
@@ -108,10 +163,9 @@ void AudioPlayer::playTrack(uint16_t track) {
   // Play the constructed filename
   playFile(filename);
   
-  // Re-enforce loop mode after starting playback
+  // Re-enforce loop mode shortly after starting playback
   // This ensures the track continues looping even after DFPlayer state changes
-  delay(100);
-  sendATCommand("AT+PLAYMODE=1");  // Repeat single track
+  _timers.arm(_loopModeTimer, _config.get(CFG_DF_LOOP_MODE_MS), onLoopModeTimer, this);
 }
 
 /**
@@ -126,9 +180,17 @@ void AudioPlayer::playFile(const String& path) {
  * Toggle play/pause state using PP command
  * 
  * Note: In main application, we set volume to 0 instead of using this
- * to avoid toggle state confusion when cards are removed/reinserted
+ * to avoid toggle state confusion when cards are removed/reinserted.
+ * Before initialization has completed, nothing is playing yet, so only
+ * the queued track is dropped.
  */
 void AudioPlayer::pause() {
+  if (!_ready) {
+    _pendingTrack = 0;
+    return;
+  }
+  
+  _timers.cancel(_loopModeTimer);  // Don't send PLAYMODE after the pause
   Serial.println("AudioPlayer: pause");
   sendATCommand("AT+PLAY=PP");  // Toggle play/pause
 }
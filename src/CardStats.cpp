@@ -0,0 +1,412 @@
+/**
+ * @file CardStats.cpp
+ * @brief Implementation of per-card usage analytics
+ * @author Jérémy Martin, generated with GitHub Copilot and ChatGPT
+ * @date 2025
+ */
+
+#include "CardStats.h"
+#include "ConfigStore.h"
+#include <LittleFS.h>
+
+extern uint8_t _FS_start;  // Start of the filesystem area (linker script)
+extern uint8_t _FS_end;    // End of the filesystem area (linker script)
+
+/**
+ * Size left for LittleFS once ConfigStore has taken the start of the area
+ * (0 makes begin() fail, so statistics stay in RAM)
+ */
+static uint32_t statsFSSize() {
+  uint32_t area = &_FS_end - &_FS_start;
+  return area > ConfigStore::REGION_SIZE ? area - ConfigStore::REGION_SIZE : 0;
+}
+
+// LittleFS mounted after the ConfigStore sectors (the global LittleFS
+// instance, which spans the whole area, is disabled in platformio.ini)
+static fs::FS StatsFS(fs::FSImplPtr(new littlefs_impl::LittleFSImpl(
+    &_FS_start + ConfigStore::REGION_SIZE, statsFSSize(), 256, 4096, 16)));
+
+static const char *LOG_PATH = "/stats.log";  // Delta log
+static const char *TMP_PATH = "/stats.tmp";  // Snapshot being written by compact()
+static const uint16_t RECORD_MAGIC = 0x5354; // "ST"
+
+/**
+ * Record stored in the log
+ *
+ * Delta records carry the plays/seconds added since the last flush;
+ * snapshot records (written by compact()) carry the totals. Both are
+ * replayed the same way: by adding them up.
+ */
+struct StatsRecord {
+  uint16_t magic;                    // RECORD_MAGIC (detects garbage)
+  uint16_t bootId;                   // Boot number of the last play
+  uint32_t plays;                    // Plays to add
+  uint32_t seconds;                  // Play time to add
+  uint32_t lastSeen;                 // Uptime (s) of the last play
+  char uid[CardStats::UID_LEN];      // Card UID
+  uint16_t check;                    // recordCheck() of the fields above
+};
+
+/**
+ * FNV-1a hash of a UID string
+ */
+static uint32_t hashUID(const char *uid) {
+  uint32_t hash = 2166136261UL;
+  while (*uid) {
+    hash ^= (uint8_t)*uid++;
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * Check value of a record: FNV-1a over every field before `check`
+ *
+ * Lets load() reject a chunk that starts with a torn record's magic but
+ * runs into the next record.
+ */
+static uint16_t recordCheck(const StatsRecord &record) {
+  uint32_t hash = 2166136261UL;
+  const uint8_t *bytes = (const uint8_t *)&record;
+  for (size_t i = 0; i < offsetof(StatsRecord, check); i++) {
+    hash ^= bytes[i];
+    hash *= 16777619UL;
+  }
+  return (uint16_t)(hash ^ (hash >> 16));
+}
+
+// Constructor: Empty table, no card playing
+CardStats::CardStats(TimerWheel &timers)
+  : _timers(timers),
+    _count(0),
+    _dirtyHead(0),
+    _dirtyCount(0),
+    _current(-1),
+    _startMs(0),
+    _bootId(1),
+    _dropped(0),
+    _mounted(false),
+    _logDamaged(false) {
+  memset(_entries, 0, sizeof(_entries));
+}
+
+/**
+ * Mount LittleFS, replay the log and start periodic flushing
+ */
+bool CardStats::begin() {
+  _mounted = StatsFS.begin();
+
+  if (_mounted) {
+    load();
+  } else {
+    Serial.println("CardStats: filesystem not available, statistics kept in RAM only");
+  }
+
+  Serial.print("CardStats: ");
+  Serial.print(_count);
+  Serial.print(" cards loaded, boot #");
+  Serial.println(_bootId);
+
+  _timers.arm(_flushTimer, FLUSH_INTERVAL_MS, onFlushTimer, this);
+  return _mounted;
+}
+
+/**
+ * Start a play for a card
+ *
+ * The play count and last seen time are updated immediately; the play
+ * time is added on each flush while playing and when the play stops.
+ */
+void CardStats::playStarted(const String &uid) {
+  playStopped();  // Close the previous play (card swapped without removal)
+
+  int16_t index = lookup(uid.c_str(), true);
+  if (index < 0) {
+    _dropped++;  // Table full - this card is not tracked
+    return;
+  }
+
+  Entry &entry = _entries[index];
+  entry.plays++;
+  entry.pendingPlays++;
+  entry.lastSeen = millis() / 1000;
+  entry.lastBoot = _bootId;
+  markDirty(index);
+
+  _current = index;
+  _startMs = millis();
+}
+
+/**
+ * Stop the current play and add the time not yet credited by flush()
+ * (rounded to seconds)
+ */
+void CardStats::playStopped() {
+  if (_current < 0) return;
+
+  uint32_t seconds = (millis() - _startMs + 500) / 1000;
+  if (seconds > 0) {
+    Entry &entry = _entries[_current];
+    entry.seconds += seconds;
+    entry.pendingSeconds += seconds;
+    markDirty(_current);
+  }
+  _current = -1;
+}
+
+/**
+ * Append up to maxEntries delta records, oldest dirty entries first
+ *
+ * The whole seconds played so far by the current card are credited first
+ * and _startMs is moved forward by the same amount, so long sessions reach
+ * flash while they run. Entries that don't fit in this batch stay queued
+ * for the next flush.
+ */
+void CardStats::flush(uint8_t maxEntries) {
+  if (_current >= 0) {
+    uint32_t seconds = (millis() - _startMs) / 1000;
+    if (seconds > 0) {
+      Entry &entry = _entries[_current];
+      entry.seconds += seconds;
+      entry.pendingSeconds += seconds;
+      _startMs += seconds * 1000;
+      markDirty(_current);
+    }
+  }
+
+  if (!_mounted || _dirtyCount == 0) return;
+
+  // Never append after a partial record: the log must be rewritten first
+  if (_logDamaged) {
+    compact();
+    if (_logDamaged) return;
+  }
+
+  File log = StatsFS.open(LOG_PATH, "a");
+  if (!log) {
+    Serial.println("CardStats: cannot open log for writing");
+    return;
+  }
+
+  uint32_t goodSize = log.size();  // End of the last complete record
+  uint8_t written = 0;
+  while (_dirtyCount > 0 && written < maxEntries) {
+    uint16_t index = _dirty[_dirtyHead];
+    Entry &entry = _entries[index];
+
+    StatsRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = RECORD_MAGIC;
+    record.bootId = entry.lastBoot;
+    record.plays = entry.pendingPlays;
+    record.seconds = entry.pendingSeconds;
+    record.lastSeen = entry.lastSeen;
+    memcpy(record.uid, entry.uid, UID_LEN);
+    record.check = recordCheck(record);
+
+    if (log.write((const uint8_t *)&record, sizeof(record)) != sizeof(record)) {
+      // Drop the partial record; if that fails too, stop appending
+      // until a compaction has rewritten the log from RAM
+      if (!log.truncate(goodSize)) {
+        _logDamaged = true;
+      }
+      log.close();
+      Serial.println("CardStats: log write failed, compacting");
+      compact();
+      return;
+    }
+    goodSize += sizeof(record);
+
+    _dirtyHead = (_dirtyHead + 1) % MAX_CARDS;
+    _dirtyCount--;
+    entry.queued = false;
+    entry.pendingPlays = 0;
+    entry.pendingSeconds = 0;
+    written++;
+  }
+
+  uint32_t size = log.size();
+  log.close();
+
+  if (size >= COMPACT_SIZE) {
+    compact();
+  }
+}
+
+/**
+ * Print one line per card, plus a summary
+ *
+ * The running play is included up to the last flush.
+ */
+void CardStats::dump() const {
+  Serial.println("CardStats: uid, plays, seconds, last seen (boot #, uptime s)");
+
+  for (uint16_t i = 0; i < TABLE_SIZE; i++) {
+    const Entry &entry = _entries[i];
+    if (entry.uid[0] == '\0') continue;
+
+    Serial.print(entry.uid);
+    Serial.print(", ");
+    Serial.print(entry.plays);
+    Serial.print(", ");
+    Serial.print(entry.seconds);
+    Serial.print(", #");
+    Serial.print(entry.lastBoot);
+    Serial.print(" +");
+    Serial.println(entry.lastSeen);
+  }
+
+  Serial.print("CardStats: ");
+  Serial.print(_count);
+  Serial.print("/");
+  Serial.print(MAX_CARDS);
+  Serial.print(" cards, ");
+  Serial.print(_dirtyCount);
+  Serial.print(" pending, ");
+  Serial.print(_dropped);
+  Serial.println(" plays dropped (table full)");
+}
+
+/**
+ * Linear probing lookup keyed by the UID string
+ *
+ * Entries are never removed, so a free slot ends the probe sequence.
+ * The table is kept at most 75% full to keep probes short.
+ */
+int16_t CardStats::lookup(const char *uid, bool create) {
+  uint32_t hash = hashUID(uid);
+
+  for (uint16_t probe = 0; probe < TABLE_SIZE; probe++) {
+    uint16_t index = (hash + probe) & (TABLE_SIZE - 1);
+    Entry &entry = _entries[index];
+
+    if (entry.uid[0] == '\0') {
+      if (!create || _count >= MAX_CARDS) return -1;
+      strncpy(entry.uid, uid, UID_LEN - 1);
+      entry.uid[UID_LEN - 1] = '\0';
+      _count++;
+      return index;
+    }
+    if (strncmp(entry.uid, uid, UID_LEN) == 0) {
+      return index;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Queue an entry for the next flush (each entry is queued at most once,
+ * so the queue can never hold more than MAX_CARDS entries)
+ */
+void CardStats::markDirty(uint16_t index) {
+  Entry &entry = _entries[index];
+  if (entry.queued) return;
+
+  entry.queued = true;
+  _dirty[(_dirtyHead + _dirtyCount) % MAX_CARDS] = index;
+  _dirtyCount++;
+}
+
+/**
+ * Replay the log into the table
+ *
+ * A truncated last record (power loss during a write) is ignored. If a
+ * chunk is not a valid record (bad magic or check, e.g. a partial record
+ * in the middle of the log),
+ * the scan moves forward one byte at a time until the next RECORD_MAGIC
+ * that starts a valid record. If power was lost during compaction, the
+ * old log is still complete (the snapshot only replaces it by rename).
+ */
+void CardStats::load() {
+  File log = StatsFS.open(LOG_PATH, "r");
+  if (!log) return;  // No statistics yet
+
+  uint16_t lastBoot = 0;
+  uint32_t size = log.size();
+  uint32_t position = 0;
+  StatsRecord record;
+  while (position + sizeof(record) <= size) {
+    log.seek(position);
+    if (log.read((uint8_t *)&record, sizeof(record)) != sizeof(record)) break;
+
+    bool valid = record.magic == RECORD_MAGIC && record.check == recordCheck(record) &&
+                 memchr(record.uid, '\0', UID_LEN) != nullptr;
+    if (!valid) {
+      position++;  // Resynchronize on the next record
+      continue;
+    }
+    position += sizeof(record);
+
+    int16_t index = lookup(record.uid, true);
+    if (index < 0) continue;
+
+    Entry &entry = _entries[index];
+    entry.plays += record.plays;
+    entry.seconds += record.seconds;
+    entry.lastSeen = record.lastSeen;  // Records are in chronological order
+    entry.lastBoot = record.bootId;
+    if (record.bootId > lastBoot) lastBoot = record.bootId;
+  }
+  log.close();
+
+  _bootId = lastBoot + 1;
+}
+
+/**
+ * Write the totals of every card to a new log and replace the old one
+ *
+ * Pending deltas are included in the snapshot, so the dirty queue is
+ * cleared once the snapshot has replaced the log. On failure nothing is
+ * cleared and the old log stays in place.
+ */
+void CardStats::compact() {
+  File snapshot = StatsFS.open(TMP_PATH, "w");
+  if (!snapshot) return;
+
+  for (uint16_t i = 0; i < TABLE_SIZE; i++) {
+    const Entry &entry = _entries[i];
+    if (entry.uid[0] == '\0') continue;
+
+    StatsRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = RECORD_MAGIC;
+    record.bootId = entry.lastBoot;
+    record.plays = entry.plays;
+    record.seconds = entry.seconds;
+    record.lastSeen = entry.lastSeen;
+    memcpy(record.uid, entry.uid, UID_LEN);
+    record.check = recordCheck(record);
+
+    if (snapshot.write((const uint8_t *)&record, sizeof(record)) != sizeof(record)) {
+      snapshot.close();
+      StatsFS.remove(TMP_PATH);  // Keep the old log
+      Serial.println("CardStats: compaction failed");
+      return;
+    }
+  }
+  snapshot.close();
+
+  // rename() replaces the old log atomically: until it succeeds, the old
+  // log is the one replayed at boot, so the pending deltas must be kept
+  if (!StatsFS.rename(TMP_PATH, LOG_PATH)) {
+    StatsFS.remove(TMP_PATH);
+    Serial.println("CardStats: compaction failed");
+    return;
+  }
+  _logDamaged = false;
+
+  for (uint16_t i = 0; i < TABLE_SIZE; i++) {
+    _entries[i].queued = false;
+    _entries[i].pendingPlays = 0;
+    _entries[i].pendingSeconds = 0;
+  }
+  _dirtyHead = 0;
+  _dirtyCount = 0;
+}
+
+// Timer callback: flush one batch and re-arm
+void CardStats::onFlushTimer(void *arg) {
+  CardStats *self = static_cast<CardStats *>(arg);
+  self->flush();
+  self->_timers.arm(self->_flushTimer, FLUSH_INTERVAL_MS, onFlushTimer, self);
+}
@@ -0,0 +1,414 @@
+/**
+ * @file ConfigStore.cpp
+ * @brief Implementation of the flash key-value store for tunables
+ * @author Jérémy Martin, generated with GitHub Copilot and ChatGPT
+ * @date 2025
+ *
+ * The table below lists every tunable parameter with its Serial name,
+ * default value and allowed range. Defaults match the values previously
+ * hard-coded in main.cpp and AudioPlayer.cpp. Ranges keep every wait short
+ * enough that the main loop still polls Serial (so a bad value can always
+ * be reset).
+ */
+
+#include "ConfigStore.h"
+#include <hardware/flash.h>
+
+extern uint8_t _FS_start;  // Start of the filesystem area (linker script)
+extern uint8_t _FS_end;    // End of the filesystem area (linker script)
+
+static const uint32_t HEADER_MAGIC = 0x454E5554;  // "TUNE"
+static const uint16_t RECORD_SIZE = 8;
+static const uint16_t RECORDS_PER_SECTOR = FLASH_SECTOR_SIZE / RECORD_SIZE;  // Slot 0 = header
+static const uint16_t DELETED_FLAG = 0x8000;      // Key flag: parameter reset to default
+static const uint16_t ERASED = 0xFFFF;            // Key/check of an unwritten slot
+
+/**
+ * Sector header (slot 0), written after the sector content
+ */
+struct SectorHeader {
+  uint32_t magic;     // HEADER_MAGIC
+  uint32_t sequence;  // Incremented on each rotation (highest = active)
+};
+
+/**
+ * Log record (slots 1 to RECORDS_PER_SECTOR - 1)
+ */
+struct ConfigRecord {
+  uint16_t key;       // Parameter key, with DELETED_FLAG for a reset
+  uint16_t check;     // recordCheck(key, value) - detects torn writes
+  uint32_t value;     // Parameter value
+};
+
+/**
+ * Parameter description: key, Serial name, default value and range
+ */
+struct ConfigKeyInfo {
+  uint16_t key;
+  const char *name;
+  uint32_t defaultValue;
+  uint32_t minValue;
+  uint32_t maxValue;
+};
+
+// removal_timeout_ms stays above the largest poll_interval_ms, so a card
+// can't be considered removed between two consecutive polls
+static const ConfigKeyInfo CONFIG_KEYS[] = {
+  { CFG_REMOVAL_TIMEOUT_MS, "removal_timeout_ms", 500,  300, 10000 },
+  { CFG_POLL_INTERVAL_MS,   "poll_interval_ms",   100,  10,  200 },
+  { CFG_MIN_VOLUME,         "min_volume",         1,    0,   30 },
+  { CFG_MAX_VOLUME,         "max_volume",         25,   0,   30 },
+  { CFG_DF_BOOT_MS,         "df_boot_ms",         1000, 0,   5000 },
+  { CFG_DF_PROMPT_MS,       "df_prompt_ms",       200,  0,   2000 },
+  { CFG_DF_MODE_SWITCH_MS,  "df_mode_switch_ms",  500,  0,   2000 },
+  { CFG_DF_LOOP_MODE_MS,    "df_loop_mode_ms",    100,  0,   2000 },
+  { CFG_DF_COMMAND_MS,      "df_command_ms",      50,   0,   200 },
+  { CFG_DF_INITIAL_VOLUME,  "df_initial_volume",  15,   0,   30 },
+};
+
+static const uint8_t CONFIG_KEY_COUNT = sizeof(CONFIG_KEYS) / sizeof(CONFIG_KEYS[0]);
+
+/**
+ * Check value stored with each record (a torn or zeroed record won't match)
+ */
+static uint16_t recordCheck(uint16_t key, uint32_t value) {
+  return key ^ (uint16_t)value ^ (uint16_t)(value >> 16) ^ 0x5A5A;
+}
+
+/**
+ * Table entry of a key (nullptr if the key is not in the table)
+ */
+static const ConfigKeyInfo *infoFor(uint16_t key) {
+  for (uint8_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    if (CONFIG_KEYS[i].key == key) return &CONFIG_KEYS[i];
+  }
+  return nullptr;
+}
+
+/**
+ * Default value of a key (0 if the key is not in the table)
+ */
+static uint32_t defaultFor(uint16_t key) {
+  const ConfigKeyInfo *info = infoFor(key);
+  return info ? info->defaultValue : 0;
+}
+
+/**
+ * Check a value against the key's range (unknown keys are never valid)
+ */
+static bool inRange(uint16_t key, uint32_t value) {
+  const ConfigKeyInfo *info = infoFor(key);
+  return info && value >= info->minValue && value <= info->maxValue;
+}
+
+/**
+ * Erase one sector
+ *
+ * Code runs from flash (XIP), so interrupts and the other core are stopped
+ * while the flash is busy (same approach as the core's EEPROM library).
+ */
+static void flashErase(uint32_t offset) {
+  noInterrupts();
+  rp2040.idleOtherCore();
+  flash_range_erase(offset, FLASH_SECTOR_SIZE);
+  rp2040.resumeOtherCore();
+  interrupts();
+}
+
+/**
+ * Program one 256-byte page (0xFF bytes leave the flash unchanged)
+ */
+static void flashProgram(uint32_t offset, const uint8_t *page) {
+  noInterrupts();
+  rp2040.idleOtherCore();
+  flash_range_program(offset, page, FLASH_PAGE_SIZE);
+  rp2040.resumeOtherCore();
+  interrupts();
+}
+
+// Constructor: All parameters at their defaults, no flash region yet
+ConfigStore::ConfigStore()
+  : _storedCount(0),
+    _region(nullptr),
+    _active(-1),
+    _sequence(0),
+    _nextSlot(1),
+    _writable(false),
+    _loadMicros(0) {
+  loadDefaults();
+}
+
+/**
+ * Locate the store region and rebuild the RAM index
+ *
+ * If the filesystem area is too small to hold the region, nothing is
+ * scanned and every key keeps its default.
+ *
+ * Process:
+ * 1. Preload every key with its default
+ * 2. Pick the sector with a valid header and the highest sequence number
+ * 3. Replay its records in order until the first erased slot
+ *
+ * Records with a bad check (power loss during a write) are skipped, and
+ * so are values outside their key's range (the default is kept).
+ */
+bool ConfigStore::begin() {
+  uint32_t start = micros();
+
+  loadDefaults();
+
+  // Store region: the first SECTORS sectors of the filesystem area, which
+  // the linker keeps clear of the firmware (LittleFS is mounted after them)
+  _region = &_FS_start;
+  _writable = (uint32_t)(&_FS_end - &_FS_start) > REGION_SIZE;
+  _active = -1;
+  _nextSlot = 1;
+
+  if (!_writable) {
+    _loadMicros = micros() - start;
+    Serial.println("ConfigStore: filesystem area too small (see platformio.ini), using defaults (read-only)");
+    return false;
+  }
+
+  // Find the active sector
+  for (uint8_t sector = 0; sector < SECTORS; sector++) {
+    SectorHeader header;
+    memcpy(&header, _region + sector * FLASH_SECTOR_SIZE, sizeof(header));
+    if (header.magic != HEADER_MAGIC) continue;
+
+    if (_active < 0 || (int32_t)(header.sequence - _sequence) > 0) {
+      _active = sector;
+      _sequence = header.sequence;
+    }
+  }
+
+  // Replay its log
+  if (_active >= 0) {
+    const uint8_t *sector = _region + _active * FLASH_SECTOR_SIZE;
+
+    while (_nextSlot < RECORDS_PER_SECTOR) {
+      ConfigRecord record;
+      memcpy(&record, sector + _nextSlot * RECORD_SIZE, sizeof(record));
+      if (record.key == ERASED && record.check == ERASED) break;  // End of log
+      _nextSlot++;
+
+      if (record.check != recordCheck(record.key, record.value)) continue;
+
+      uint16_t key = record.key & ~DELETED_FLAG;
+      if (key >= MAX_KEYS) continue;
+
+      bool wasStored = isStored(key);
+      if ((record.key & DELETED_FLAG) || !inRange(key, record.value)) {
+        // Reset, or a value this firmware doesn't accept: use the default
+        _values[key] = defaultFor(key);
+        _stored[key >> 3] &= ~(1 << (key & 7));
+        if (wasStored) _storedCount--;
+      } else {
+        _values[key] = record.value;
+        _stored[key >> 3] |= (1 << (key & 7));
+        if (!wasStored) _storedCount++;
+      }
+    }
+  }
+
+  _loadMicros = micros() - start;
+
+  Serial.print("ConfigStore: ");
+  Serial.print(_storedCount);
+  Serial.print(" stored values loaded in ");
+  Serial.print(_loadMicros);
+  Serial.println(" us");
+  return true;
+}
+
+/**
+ * Store a value after checking its range, skipping the flash write if it
+ * is unchanged
+ */
+ConfigResult ConfigStore::set(uint16_t key, uint32_t value) {
+  if (!infoFor(key)) return CONFIG_UNKNOWN_KEY;
+  if (!inRange(key, value)) return CONFIG_OUT_OF_RANGE;
+  if (isStored(key) && _values[key] == value) return CONFIG_OK;
+
+  if (!append(key, value)) return CONFIG_FLASH_ERROR;
+
+  if (!isStored(key)) {
+    _stored[key >> 3] |= (1 << (key & 7));
+    _storedCount++;
+  }
+  _values[key] = value;
+  return CONFIG_OK;
+}
+
+/**
+ * Append a reset record so the key falls back to its default
+ */
+bool ConfigStore::reset(uint16_t key) {
+  if (key >= MAX_KEYS) return false;
+  if (!isStored(key)) return true;
+
+  if (!append(key | DELETED_FLAG, 0)) return false;
+
+  _stored[key >> 3] &= ~(1 << (key & 7));
+  _storedCount--;
+  _values[key] = defaultFor(key);
+  return true;
+}
+
+/**
+ * Look up a parameter by its Serial name
+ */
+bool ConfigStore::keyForName(const String &name, uint16_t &keyOut) {
+  for (uint8_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    if (name == CONFIG_KEYS[i].name) {
+      keyOut = CONFIG_KEYS[i].key;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Get the allowed range of a parameter from the table
+ */
+bool ConfigStore::rangeFor(uint16_t key, uint32_t &minOut, uint32_t &maxOut) {
+  const ConfigKeyInfo *info = infoFor(key);
+  if (!info) return false;
+
+  minOut = info->minValue;
+  maxOut = info->maxValue;
+  return true;
+}
+
+/**
+ * Print "name = value [min..max]" for each known parameter, then the log state
+ */
+void ConfigStore::dump() const {
+  for (uint8_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    const ConfigKeyInfo &info = CONFIG_KEYS[i];
+    Serial.print(info.name);
+    Serial.print(" = ");
+    Serial.print(get(info.key));
+    Serial.print(" [");
+    Serial.print(info.minValue);
+    Serial.print("..");
+    Serial.print(info.maxValue);
+    Serial.print("]");
+    if (isStored(info.key)) {
+      Serial.print(" (default ");
+      Serial.print(info.defaultValue);
+      Serial.print(")");
+    }
+    Serial.println();
+  }
+
+  Serial.print("ConfigStore: sector ");
+  Serial.print(_active);
+  Serial.print(", sequence ");
+  Serial.print(_sequence);
+  Serial.print(", ");
+  Serial.print(_nextSlot - 1);
+  Serial.print("/");
+  Serial.print(RECORDS_PER_SECTOR - 1);
+  Serial.print(" records used, loaded in ");
+  Serial.print(_loadMicros);
+  Serial.println(" us");
+}
+
+/**
+ * Reset the RAM index: defaults for known keys, 0 for the others
+ */
+void ConfigStore::loadDefaults() {
+  memset(_values, 0, sizeof(_values));
+  memset(_stored, 0, sizeof(_stored));
+  _storedCount = 0;
+
+  for (uint8_t i = 0; i < CONFIG_KEY_COUNT; i++) {
+    _values[CONFIG_KEYS[i].key] = CONFIG_KEYS[i].defaultValue;
+  }
+}
+
+/**
+ * Write one record into the next free slot of the active sector
+ *
+ * The page containing the slot is programmed with 0xFF everywhere else,
+ * which leaves the other records untouched. The record is read back to
+ * make sure the write succeeded.
+ */
+bool ConfigStore::append(uint16_t key, uint32_t value) {
+  if (!_writable) return false;
+
+  if (_active < 0 || _nextSlot >= RECORDS_PER_SECTOR) {
+    if (!rotate()) return false;
+  }
+
+  ConfigRecord record = { key, recordCheck(key, value), value };
+
+  const uint8_t *address = _region + _active * FLASH_SECTOR_SIZE + _nextSlot * RECORD_SIZE;
+  const uint8_t *page = (const uint8_t *)((uintptr_t)address & ~(uintptr_t)(FLASH_PAGE_SIZE - 1));
+
+  uint8_t buffer[FLASH_PAGE_SIZE];
+  memset(buffer, 0xFF, sizeof(buffer));
+  memcpy(buffer + (address - page), &record, sizeof(record));
+  flashProgram((uintptr_t)page - XIP_BASE, buffer);
+
+  _nextSlot++;  // Slot is used even if the write failed
+  return memcmp(address, &record, sizeof(record)) == 0;
+}
+
+/**
+ * Move to the next sector of the ring (wear levelling + compaction)
+ *
+ * Process:
+ * 1. Erase the next sector
+ * 2. Write one record per stored key, a page at a time
+ * 3. Write the header with the next sequence number
+ *
+ * Until step 3 completes, begin() still selects the previous sector.
+ */
+bool ConfigStore::rotate() {
+  uint8_t next = (_active < 0) ? 0 : (_active + 1) % SECTORS;
+  const uint8_t *sector = _region + next * FLASH_SECTOR_SIZE;
+  uint32_t offset = (uintptr_t)sector - XIP_BASE;
+
+  flashErase(offset);
+
+  uint8_t buffer[FLASH_PAGE_SIZE];
+  memset(buffer, 0xFF, sizeof(buffer));
+  uint16_t slot = 1;
+
+  for (uint16_t key = 0; key < MAX_KEYS; key++) {
+    if (!isStored(key)) continue;
+
+    ConfigRecord record = { key, recordCheck(key, _values[key]), _values[key] };
+    uint32_t position = slot * RECORD_SIZE;
+    memcpy(buffer + position % FLASH_PAGE_SIZE, &record, sizeof(record));
+    slot++;
+
+    // Page full: program it and start the next one
+    if ((slot * RECORD_SIZE) % FLASH_PAGE_SIZE == 0) {
+      flashProgram(offset + position - position % FLASH_PAGE_SIZE, buffer);
+      memset(buffer, 0xFF, sizeof(buffer));
+    }
+  }
+  if ((slot * RECORD_SIZE) % FLASH_PAGE_SIZE != 0) {
+    uint32_t position = slot * RECORD_SIZE;
+    flashProgram(offset + position - position % FLASH_PAGE_SIZE, buffer);
+  }
+
+  // Header last: the sector only becomes valid once fully written
+  SectorHeader header = { HEADER_MAGIC, _sequence + 1 };
+  memset(buffer, 0xFF, sizeof(buffer));
+  memcpy(buffer, &header, sizeof(header));
+  flashProgram(offset, buffer);
+
+  if (memcmp(sector, &header, sizeof(header)) != 0) {
+    Serial.println("ConfigStore: sector rotation failed");
+    return false;
+  }
+
+  _active = next;
+  _sequence++;
+  _nextSlot = slot;
+  return true;
+}
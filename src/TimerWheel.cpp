@@ -0,0 +1,163 @@
+/**
+ * @file TimerWheel.cpp
+ * @brief Implementation of the hierarchical timing wheel
+ * @author Jérémy Martin, generated with GitHub Copilot and ChatGPT
+ * @date 2025
+ */
+
+#include "TimerWheel.h"
+
+static const uint32_t SLOT_MASK = TimerWheel::SLOTS - 1;
+
+// Constructor: Empty wheel starting at time 0
+TimerWheel::TimerWheel(uint16_t tickMs)
+  : _tickMs(tickMs ? tickMs : 1),
+    _lastMs(0),
+    _ticks(0) {
+  for (uint8_t level = 0; level < LEVELS; level++) {
+    for (uint16_t slot = 0; slot < SLOTS; slot++) {
+      _slots[level][slot] = nullptr;
+    }
+  }
+}
+
+/**
+ * Set the time origin used to convert millis() into ticks
+ */
+void TimerWheel::begin(uint32_t nowMs) {
+  _lastMs = nowMs;
+}
+
+/**
+ * Arm a timer relative to the current tick
+ *
+ * The delay is rounded up to whole ticks. Slot _ticks is processed by the
+ * next elapsed tick, so a delay of N ticks expires at _ticks + N - 1.
+ */
+void TimerWheel::arm(Timer &timer, uint32_t delayMs, TimerCallback callback, void *arg) {
+  cancel(timer);
+
+  uint32_t ticks = delayMs / _tickMs + ((delayMs % _tickMs) ? 1 : 0);
+  if (ticks > MAX_TICKS) ticks = MAX_TICKS;  // Clamp to wheel range
+
+  timer.expires = _ticks + (ticks ? ticks - 1 : 0);
+  timer.callback = callback;
+  timer.arg = arg;
+  insert(timer);
+}
+
+/**
+ * Unlink a timer from its slot (O(1) thanks to the pprev back-link)
+ */
+void TimerWheel::cancel(Timer &timer) {
+  if (!timer.isArmed()) return;
+
+  *timer.pprev = timer.next;
+  if (timer.next) {
+    timer.next->pprev = timer.pprev;
+  }
+  timer.next = nullptr;
+  timer.pprev = nullptr;
+}
+
+/**
+ * Convert elapsed milliseconds into ticks and process each of them
+ *
+ * Only whole ticks are consumed; the remainder is carried over to the
+ * next call. Unsigned subtraction keeps this correct across millis() rollover.
+ */
+void TimerWheel::advance(uint32_t nowMs) {
+  uint32_t elapsed = (nowMs - _lastMs) / _tickMs;
+  _lastMs += elapsed * _tickMs;
+
+  while (elapsed--) {
+    step();
+  }
+}
+
+/**
+ * Place a timer in the wheel level that matches its distance from now
+ *
+ * Level 0 holds timers expiring in the next 64 ticks, level 1 in the next
+ * 64^2 ticks, and so on. Timers already in the past go to the current slot.
+ */
+void TimerWheel::insert(Timer &timer) {
+  uint32_t delta = timer.expires - _ticks;
+  Timer **head;
+
+  if ((int32_t)delta < 0) {
+    // Already expired (e.g. cascaded late) - run on the next tick
+    head = &_slots[0][_ticks & SLOT_MASK];
+  } else {
+    uint8_t level = 0;
+    while (level < LEVELS - 1 && delta >= (1UL << ((level + 1) * SLOT_BITS))) {
+      level++;
+    }
+    head = &_slots[level][(timer.expires >> (level * SLOT_BITS)) & SLOT_MASK];
+  }
+
+  // Push at the head of the slot list
+  timer.next = *head;
+  if (timer.next) {
+    timer.next->pprev = &timer.next;
+  }
+  *head = &timer;
+  timer.pprev = head;
+}
+
+/**
+ * Move every timer of a higher-level slot down to the level it now belongs to
+ */
+void TimerWheel::cascade(uint8_t level, uint8_t slot) {
+  Timer *list = _slots[level][slot];
+  _slots[level][slot] = nullptr;
+
+  while (list) {
+    Timer *timer = list;
+    list = timer->next;
+    insert(*timer);
+  }
+}
+
+/**
+ * Process one tick
+ *
+ * 1. When level 0 wraps around, refill it from the next level (and so on)
+ * 2. Detach the current level 0 slot and run each timer's callback
+ *
+ * The slot is detached into a local list first, so callbacks can safely
+ * re-arm or cancel any timer (including ones still waiting in that list).
+ */
+void TimerWheel::step() {
+  uint8_t index = _ticks & SLOT_MASK;
+
+  if (index == 0) {
+    for (uint8_t level = 1; level < LEVELS; level++) {
+      uint8_t slot = (_ticks >> (level * SLOT_BITS)) & SLOT_MASK;
+      cascade(level, slot);
+      if (slot != 0) break;  // Higher levels only cascade when this one wraps
+    }
+  }
+
+  _ticks++;  // Timers armed from callbacks land in the following ticks
+
+  Timer *pending = _slots[0][index];
+  _slots[0][index] = nullptr;
+  if (pending) {
+    pending->pprev = &pending;
+  }
+
+  while (pending) {
+    Timer *timer = pending;
+    pending = timer->next;
+    if (pending) {
+      pending->pprev = &pending;
+    }
+    timer->next = nullptr;
+    timer->pprev = nullptr;
+
+    if (timer->callback) {
+      timer->callback(timer->arg);
+    }
+  }
+}
@@ -20,6 +20,9 @@
 #include "RfidReader.h"
 #include "AudioPlayer.h"
 #include "CardRouter.h"
+#include "TimerWheel.h"
+#include "CardStats.h"
+#include "ConfigStore.h"
 
 // ========== PIN CONFIGURATION ==========
 
@@ -34,21 +37,217 @@ const uint8_t DF_RX_PIN = 13;  // Pico GP13 (RX) <- DFPlayer TX
 
 // Volume control potentiometer
 const uint8_t POT_PIN = 26;    // GP26 (ADC0) - analog input
-const uint8_t MIN_VOLUME = 1;  // Minimum volume level
-const uint8_t MAX_VOLUME = 25; // Maximum volume level
+
+// Timing and volume range are tunable at runtime (see ConfigStore):
+// removal_timeout_ms, poll_interval_ms, min_volume, max_volume
 
 // ========== GLOBAL OBJECTS ==========
 
-RfidReader  rfid(RFID_SS_PIN, RFID_RST_PIN);  // RFID reader instance
-AudioPlayer audio(DF_TX_PIN, DF_RX_PIN);      // Audio player instance
+TimerWheel  timers;                                   // Shared timing wheel (10ms ticks)
+ConfigStore config;                                   // Tunable parameters (flash)
+RfidReader  rfid(RFID_SS_PIN, RFID_RST_PIN);          // RFID reader instance
+AudioPlayer audio(DF_TX_PIN, DF_RX_PIN, timers, config);  // Audio player instance
+CardStats   cardStats(timers);                        // Per-card usage statistics
 
 // ========== STATE VARIABLES ==========
 
 String currentUID = "";                    // UID of currently playing card
 int lastVolume = -1;                      // Last volume setting (for change detection)
 bool isPlaying = false;                   // Tracks if music is currently playing
-int missedReads = 0;                      // Counter for consecutive failed card reads
-const int REMOVAL_THRESHOLD = 5;          // Failed reads needed before card is considered removed
+Timer removalTimer;                       // Re-armed on every read, expires after removal_timeout_ms
+bool removalDue = false;                  // removalTimer expired, confirmed by the next failed read
+String serialLine = "";                   // Serial command being received
+
+/**
+ * @brief removalTimer callback: no read for removal_timeout_ms
+ * 
+ * Only raises a flag. The card is removed by loop() when the next read
+ * also fails, so a long blocking call (flash write, Serial command) that
+ * delays the polls can't remove a card that is still on the reader.
+ */
+void onRemovalTimeout(void *) {
+  removalDue = true;
+}
+
+/**
+ * @brief Handle card removal
+ * 
+ * Called when removalTimer has expired and the card still can't be read.
+ * The timer is re-armed on every successful read, so this only happens
+ * after removal_timeout_ms without reads. This provides debouncing for
+ * unreliable RFID reads.
+ */
+void onCardRemoved() {
+  Serial.println("Card removed - pausing music.");
+  if (isPlaying) {
+    audio.pause();  // Pause only if music is playing
+    cardStats.playStopped();
+  }
+  isPlaying = false;
+  currentUID = "";
+}
+
+/**
+ * @brief Parse a plain non-negative decimal integer
+ * 
+ * Accepts only digits (no sign, spaces or suffix) and at most 9 of them,
+ * so the result always fits in 32 bits.
+ * 
+ * @param text Text to parse
+ * @param valueOut Receives the value on success
+ * @return true if text is a valid number
+ */
+bool parseUnsigned(const String &text, uint32_t &valueOut) {
+  if (text.length() == 0 || text.length() > 9) return false;
+
+  uint32_t value = 0;
+  for (unsigned int i = 0; i < text.length(); i++) {
+    char c = text[i];
+    if (c < '0' || c > '9') return false;
+    value = value * 10 + (c - '0');
+  }
+  valueOut = value;
+  return true;
+}
+
+/**
+ * @brief Serial command: set <name> <value>
+ * 
+ * Only parses the text; the range is checked by ConfigStore::set().
+ * 
+ * @param name Parameter name
+ * @param value Value as typed
+ */
+void setParameter(const String &name, const String &value) {
+  uint16_t key;
+  if (!ConfigStore::keyForName(name, key)) {
+    Serial.print("Unknown parameter: ");
+    Serial.println(name);
+    return;
+  }
+
+  uint32_t number;
+  if (!parseUnsigned(value, number)) {
+    Serial.print("Invalid value: ");
+    Serial.print(value);
+    Serial.println(" (expected a non-negative integer)");
+    return;
+  }
+
+  ConfigResult result = config.set(key, number);
+  if (result == CONFIG_OUT_OF_RANGE) {
+    uint32_t minValue, maxValue;
+    ConfigStore::rangeFor(key, minValue, maxValue);
+    Serial.print("Out of range: ");
+    Serial.print(name);
+    Serial.print(" must be between ");
+    Serial.print(minValue);
+    Serial.print(" and ");
+    Serial.println(maxValue);
+    return;
+  }
+
+  Serial.print(result == CONFIG_OK ? "Set " : "Failed to set ");
+  Serial.print(name);
+  Serial.print(" = ");
+  Serial.println(config.get(key));
+}
+
+/**
+ * @brief Serial command: reset <name>
+ * @param name Parameter name
+ */
+void resetParameter(const String &name) {
+  uint16_t key;
+  if (!ConfigStore::keyForName(name, key)) {
+    Serial.print("Unknown parameter: ");
+    Serial.println(name);
+    return;
+  }
+
+  bool ok = config.reset(key);
+  Serial.print(ok ? "Reset " : "Failed to reset ");
+  Serial.print(name);
+  Serial.print(" = ");
+  Serial.println(config.get(key));
+}
+
+/**
+ * @brief Execute a command received over Serial
+ * 
+ * Commands:
+ * - stats              : print per-card usage statistics
+ * - flush              : write all pending statistics to flash
+ * - config             : print all tunable parameters
+ * - set <name> <value> : store a tunable parameter in flash
+ * - reset <name>       : restore a tunable parameter to its default
+ * 
+ * @param cmd Command line without line ending
+ */
+void handleCommand(const String &cmd) {
+  // Split "verb name value"
+  int firstSpace = cmd.indexOf(' ');
+  String verb = (firstSpace < 0) ? cmd : cmd.substring(0, firstSpace);
+  String args = (firstSpace < 0) ? String("") : cmd.substring(firstSpace + 1);
+  int secondSpace = args.indexOf(' ');
+  String name = (secondSpace < 0) ? args : args.substring(0, secondSpace);
+  String value = (secondSpace < 0) ? String("") : args.substring(secondSpace + 1);
+
+  if (verb == "stats") {
+    cardStats.dump();
+    return;
+  }
+
+  if (verb == "flush") {
+    cardStats.flush(CardStats::MAX_CARDS);
+    Serial.println("Statistics flushed.");
+    return;
+  }
+
+  if (verb == "config") {
+    config.dump();
+    return;
+  }
+
+  if (verb == "set") {
+    if (name.length() == 0 || value.length() == 0) {
+      Serial.println("Usage: set <name> <value>");
+      return;
+    }
+    setParameter(name, value);
+    return;
+  }
+
+  if (verb == "reset") {
+    if (name.length() == 0) {
+      Serial.println("Usage: reset <name>");
+      return;
+    }
+    resetParameter(name);
+    return;
+  }
+
+  Serial.print("Unknown command: ");
+  Serial.println(cmd);
+  Serial.println("Commands: stats, flush, config, set <name> <value>, reset <name>");
+}
+
+/**
+ * @brief Collect Serial input without blocking and run complete lines
+ */
+void pollSerialCommands() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\n' || c == '\r') {
+      if (serialLine.length() > 0) {
+        handleCommand(serialLine);
+        serialLine = "";
+      }
+    } else if (serialLine.length() < 64) {
+      serialLine += c;
+    }
+  }
+}
 
 /**
  * @brief Initialize hardware and modules
@@ -78,31 +277,47 @@ void setup() {
   // Initialize potentiometer pin
   pinMode(POT_PIN, INPUT);
   
+  // Start the timing wheel before any module arms a timer
+  timers.begin(millis());
+  
+  // Load tunable parameters before any module reads them
+  config.begin();
+  
+  // Load usage statistics from flash
+  cardStats.begin();
+  
   // Initialize RFID reader
   rfid.begin();
   
-  // Initialize audio player
+  // Initialize audio player (completes in the background from timers;
+  // audio.isReady() becomes true and "DFPlayer PRO ready." is logged
+  // once the sequence has finished). RFID works in the meantime.
   audio.begin();
-  if (!audio.isReady()) {
-    Serial.println("Warning: DFPlayer not ready. RFID will still work.");
-  }
 }
 
 /**
  * @brief Main loop - handles volume control and card detection
  * 
  * Continuously:
- * 1. Reads potentiometer and updates volume if changed
- * 2. Checks for RFID card presence
- * 3. Plays associated track when new card is detected
- * 4. Pauses music when card is removed
- * 5. Handles card read failures with debouncing
+ * 1. Advances the timing wheel (runs expired timers)
+ * 2. Reads potentiometer and updates volume if changed
+ * 3. Checks for RFID card presence
+ * 4. Plays associated track when new card is detected
+ * 5. Pauses music when card is removed (removalTimer expired and read failed)
+ * 6. Reports play start/stop to CardStats and handles Serial commands
  */
 void loop() {
+  // ========== TIMERS ==========
+  timers.advance(millis());
+  
+  // ========== SERIAL COMMANDS ==========
+  pollSerialCommands();
+  
   // ========== VOLUME CONTROL ==========
   // Read potentiometer and update volume if it has changed
   int potValue = analogRead(POT_PIN);
-  int currentVolume = map(potValue, 0, 1023, MIN_VOLUME, MAX_VOLUME);
+  int currentVolume = map(potValue, 0, 1023,
+                          config.get(CFG_MIN_VOLUME), config.get(CFG_MAX_VOLUME));
   
   if (currentVolume != lastVolume) {
     lastVolume = currentVolume;
@@ -116,8 +331,9 @@ void loop() {
   bool cardDetected = rfid.readCard(uid);
   
   if (cardDetected) {
-    // Card successfully read
-    missedReads = 0;  // Reset missed read counter
+    // Card successfully read - push back the removal timeout
+    removalDue = false;
+    timers.arm(removalTimer, config.get(CFG_REMOVAL_TIMEOUT_MS), onRemovalTimeout);
     
     if (uid != currentUID) {
       // New or different card detected
@@ -133,6 +349,7 @@ void loop() {
         Serial.println("No track mapped for this card.");
         if (isPlaying) {
           audio.pause();  // Pause only if music is playing
+          cardStats.playStopped();
         }
         isPlaying = false;
       } else {
@@ -140,31 +357,17 @@ void loop() {
         Serial.print("Playing track ");
         Serial.println(track);
         audio.playTrack(track);
+        cardStats.playStarted(uid);  // Also closes the previous card's play
         isPlaying = true;
       }
     }
     // Same card still present - continue playing
-  } else {
-    // ========== CARD REMOVAL DETECTION ==========
-    // No card detected in this iteration
-    if (currentUID != "") {
-      // We had a card previously
-      missedReads++;
-      
-      // Only consider card removed after multiple consecutive misses
-      // This provides debouncing for unreliable RFID reads
-      if (missedReads >= REMOVAL_THRESHOLD) {
-        Serial.println("Card removed - pausing music.");
-        if (isPlaying) {
-          audio.pause();  // Pause only if music is playing
-        }
-        isPlaying = false;
-        currentUID = "";
-        missedReads = 0;
-      }
-    }
+  } else if (removalDue) {
+    // No read for removal_timeout_ms, and the card is still not there
+    removalDue = false;
+    onCardRemoved();
   }
   
-  // Poll every 100ms - balance between responsiveness and CPU usage
-  delay(100);
+  // Poll every 100ms by default - balance between responsiveness and CPU usage
+  delay(config.get(CFG_POLL_INTERVAL_MS));
 }